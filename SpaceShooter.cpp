@@ -1,9 +1,36 @@
 #include "/opt/homebrew/Cellar/sfml@2/2.6.2/include/SFML/Graphics.hpp"
+#define GL_GLEXT_PROTOTYPES  // Pixel buffer object entry points on Linux/Mesa
+#include "/opt/homebrew/Cellar/sfml@2/2.6.2/include/SFML/OpenGL.hpp"
 #include <vector>
 #include <memory>
 #include <cmath>
 #include <random>
 #include <list>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <iterator>
+#include <tuple>
+#include <utility>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 // Forward declarations
 enum class PowerUpType {
@@ -16,9 +43,90 @@ enum class EnemyType {
     Basic,
     Scout,
     Tank,
-    Zigzag
+    Zigzag,
+    SineDive,
+    Homing,
+    Formation,
+    Count  // Number of types, not a type
 };
 
+// One tick of player controls. Gameplay reads this instead of the keyboard so
+// that a session can be recorded and replayed deterministically.
+struct PlayerInput {
+    bool left = false;
+    bool right = false;
+    bool up = false;
+    bool down = false;
+    bool fire = false;
+
+    static PlayerInput fromKeyboard() {
+        PlayerInput input;
+        input.left = sf::Keyboard::isKeyPressed(sf::Keyboard::Left);
+        input.right = sf::Keyboard::isKeyPressed(sf::Keyboard::Right);
+        input.up = sf::Keyboard::isKeyPressed(sf::Keyboard::Up);
+        input.down = sf::Keyboard::isKeyPressed(sf::Keyboard::Down);
+        input.fire = sf::Keyboard::isKeyPressed(sf::Keyboard::Space);
+        return input;
+    }
+
+    std::uint8_t pack() const {
+        return static_cast<std::uint8_t>(left | (right << 1) | (up << 2) | (down << 3) | (fire << 4));
+    }
+
+    static PlayerInput unpack(std::uint8_t bits) {
+        PlayerInput input;
+        input.left = bits & 1;
+        input.right = bits & 2;
+        input.up = bits & 4;
+        input.down = bits & 8;
+        input.fire = bits & 16;
+        return input;
+    }
+};
+
+// Playfield size in world units. Gameplay runs entirely in these units and
+// views scale them to the window or capture target, so the same logic works
+// at any resolution. The original game was tuned for 800x600.
+struct Playfield {
+    static constexpr float kReferenceWidth = 800.f;
+    static constexpr float kReferenceHeight = 600.f;
+    static constexpr float kDespawnMargin = 50.f;
+    static constexpr float kMinSize = 200.f;  // Room for the spawn margins and the player
+    static constexpr float kMaxSize = 7680.f;  // 8K; star count grows with area
+
+    float width = kReferenceWidth;
+    float height = kReferenceHeight;
+
+    bool isValid() const {
+        return std::isfinite(width) && std::isfinite(height) &&
+               width >= kMinSize && height >= kMinSize &&
+               width <= kMaxSize && height <= kMaxSize;
+    }
+
+    // Star counts scale with this: stars are spread over the whole field
+    float areaScale() const {
+        return (width * height) / (kReferenceWidth * kReferenceHeight);
+    }
+
+    // Enemies and power-ups enter along the top edge and fall at a fixed
+    // speed, so scaling their spawn rate by width keeps density constant
+    float widthScale() const {
+        return width / kReferenceWidth;
+    }
+
+    bool isBelow(float y) const { return y > height + kDespawnMargin; }
+    bool isAbove(float y) const { return y < -kDespawnMargin; }
+};
+
+// O(1) unordered removal: the last element takes the removed one's slot
+template <typename T>
+void swapRemove(std::vector<T>& items, std::size_t index) {
+    if (index + 1 != items.size()) {
+        items[index] = std::move(items.back());
+    }
+    items.pop_back();
+}
+
 // Particle System
 class Particle {
 public:
@@ -80,13 +188,16 @@ public:
         particles.remove_if([deltaTime](Particle& p) { return !p.update(deltaTime); });
     }
 
-    void draw(sf::RenderWindow& window) {
+    void draw(sf::RenderTarget& target, const sf::FloatRect& visibleArea) {
         sf::CircleShape shape;
         for (const auto& particle : particles) {
+            sf::FloatRect bounds(particle.position.x, particle.position.y,
+                                 particle.size * 2, particle.size * 2);
+            if (!bounds.intersects(visibleArea)) continue;
             shape.setPosition(particle.position);
             shape.setRadius(particle.size);
             shape.setFillColor(particle.color);
-            window.draw(shape);
+            target.draw(shape);
         }
     }
 };
@@ -99,9 +210,11 @@ private:
     float twinkleTimer;
     float twinkleInterval;
     sf::Color baseColor;
+    float wrapHeight;
 
 public:
-    Star(float x, float y, float size, float spd) : speed(spd), twinkleTimer(0.f) {
+    Star(float x, float y, float size, float spd, float fieldHeight)
+        : speed(spd), twinkleTimer(0.f), wrapHeight(fieldHeight) {
         shape.setPosition(x, y);
         shape.setRadius(size);
         
@@ -127,7 +240,7 @@ public:
     void update(float deltaTime) {
         // Move star
         float newY = shape.getPosition().y + speed * deltaTime;
-        if (newY > 600.f) {
+        if (newY > wrapHeight) {
             newY = -5.f;
         }
         shape.setPosition(shape.getPosition().x, newY);
@@ -146,8 +259,27 @@ public:
         }
     }
 
-    void draw(sf::RenderWindow& window) {
-        window.draw(shape);
+    void draw(sf::RenderTarget& target) {
+        target.draw(shape);
+    }
+};
+
+// Textures are loaded once and shared by every sprite that uses them. The
+// map never moves its nodes, so sprites can keep pointing into it. Owned by
+// whoever owns the GL context, never static: SFML needs the context alive to
+// release them.
+class TextureCache {
+private:
+    std::map<std::string, sf::Texture> textures;
+
+public:
+    const sf::Texture& get(const std::string& path) {
+        auto it = textures.find(path);
+        if (it == textures.end()) {
+            it = textures.emplace(path, sf::Texture()).first;
+            it->second.loadFromFile(path);
+        }
+        return it->second;
     }
 };
 
@@ -157,46 +289,63 @@ protected:
     sf::Vector2f velocity;
     std::unique_ptr<sf::Sprite> sprite;
     float speed;
-    sf::Texture texture;
+    std::uint32_t id = 0;
+    bool despawnQueued = false;
 
 public:
     GameObject(const sf::Vector2f& pos, float spd) 
         : position(pos), speed(spd), velocity(0.f, 0.f) {}
+    GameObject(GameObject&&) = default;
+    GameObject& operator=(GameObject&&) = default;
     
-    virtual void update(float deltaTime) = 0;
+    // Straight-line motion; subclasses add their own behavior
+    virtual void update(float deltaTime) {
+        position += velocity * deltaTime;
+    }
     
-    virtual void draw(sf::RenderWindow& window) {
+    virtual void draw(sf::RenderTarget& target) {
         if (sprite) {
             sprite->setPosition(position);
-            window.draw(*sprite);
+            target.draw(*sprite);
         }
     }
     
     virtual ~GameObject() = default;
     
     sf::Vector2f getPosition() const { return position; }
-    sf::FloatRect getBounds() const { return sprite->getGlobalBounds(); }
+    void setPosition(const sf::Vector2f& pos) { position = pos; }
+    // The sprite is otherwise only moved when drawn; sync it so bounds are current
+    sf::FloatRect getBounds() const {
+        sprite->setPosition(position);
+        return sprite->getGlobalBounds();
+    }
     bool isColliding(const GameObject& other) const {
         return getBounds().intersects(other.getBounds());
     }
     void setVelocity(const sf::Vector2f& vel) { velocity = vel; }
+    sf::Vector2f getVelocity() const { return velocity; }
+    std::uint32_t getId() const { return id; }
+    void setId(std::uint32_t newId) { id = newId; }
+    
+    // Returns false if the object was already queued this tick
+    bool queueDespawn() {
+        if (despawnQueued) return false;
+        despawnQueued = true;
+        return true;
+    }
+    bool isDespawnQueued() const { return despawnQueued; }
 };
 
 class Bullet : public GameObject {
 public:
-    Bullet(const sf::Vector2f& pos, float spd) : GameObject(pos, spd) {
-        texture.loadFromFile("bullet.png");
+    Bullet(const sf::Vector2f& pos, float spd, const sf::Texture& texture) : GameObject(pos, spd) {
         sprite = std::make_unique<sf::Sprite>(texture);
         sprite->setScale(0.8f, 0.8f);
         velocity = sf::Vector2f(0.f, -speed);
     }
 
-    void update(float deltaTime) override {
-        position += velocity * deltaTime;
-    }
-
-    bool isOffScreen() const {
-        return position.y < -50.f;
+    bool isOffScreen(const Playfield& field) const {
+        return field.isAbove(position.y);
     }
 };
 
@@ -207,10 +356,9 @@ private:
     float angle;
 
 public:
-    PowerUp(const sf::Vector2f& pos, PowerUpType t) 
+    PowerUp(const sf::Vector2f& pos, PowerUpType t, const sf::Texture& texture) 
         : GameObject(pos, 100.f), type(t), rotationSpeed(90.f), angle(0.f) {
         
-        texture.loadFromFile("powerup.png");
         sprite = std::make_unique<sf::Sprite>(texture);
         sprite->setScale(0.6f, 0.6f);
         
@@ -239,7 +387,7 @@ public:
     }
 
     PowerUpType getType() const { return type; }
-    bool isOffScreen() const { return position.y > 650.f; }
+    bool isOffScreen(const Playfield& field) const { return field.isBelow(position.y); }
 };
 
 class Player : public GameObject {
@@ -254,10 +402,14 @@ private:
     bool hasPowerUp = false;
     float invincibilityTimer = 0.f;
     bool isInvincible = false;
+    PlayerInput input;
+    Playfield field;
+    const sf::Texture& bulletTexture;
 
 public:
-    Player(const sf::Vector2f& pos, float spd) : GameObject(pos, spd), lives(3) {
-        texture.loadFromFile("player.png");
+    Player(const sf::Vector2f& pos, float spd, const Playfield& bounds,
+           const sf::Texture& texture, const sf::Texture& bulletTex)
+        : GameObject(pos, spd), lives(3), field(bounds), bulletTexture(bulletTex) {
         sprite = std::make_unique<sf::Sprite>(texture);
         sprite->setScale(0.8f, 0.8f);
     }
@@ -284,21 +436,21 @@ public:
                 static_cast<sf::Uint8>(std::abs(std::sin(invincibilityTimer * 10)) * 255)));
         }
 
-        // Handle keyboard input
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) {
+        // Handle input
+        if (input.left) {
             velocity.x = -speed;
         }
-        else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) {
+        else if (input.right) {
             velocity.x = speed;
         }
         else {
             velocity.x = 0;
         }
 
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up)) {
+        if (input.up) {
             velocity.y = -speed;
         }
-        else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down)) {
+        else if (input.down) {
             velocity.y = speed;
         }
         else {
@@ -307,49 +459,39 @@ public:
 
         // Keep player in bounds
         position += velocity * deltaTime;
-        position.x = std::max(0.f, std::min(position.x, 800.f - sprite->getGlobalBounds().width));
-        position.y = std::max(0.f, std::min(position.y, 600.f - sprite->getGlobalBounds().height));
+        position.x = std::max(0.f, std::min(position.x, field.width - sprite->getGlobalBounds().width));
+        position.y = std::max(0.f, std::min(position.y, field.height - sprite->getGlobalBounds().height));
 
         // Handle shooting
         currentCooldown -= deltaTime;
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space) && currentCooldown <= 0) {
+        if (input.fire && currentCooldown <= 0) {
             shoot();
             currentCooldown = shootCooldown;
         }
 
-        // Update bullets
-        for (auto it = bullets.begin(); it != bullets.end();) {
-            (*it)->update(deltaTime);
-            if ((*it)->isOffScreen()) {
-                it = bullets.erase(it);
-            } else {
-                ++it;
-            }
+        // Update bullets; the game despawns them once they leave the playfield
+        for (auto& bullet : bullets) {
+            bullet->update(deltaTime);
         }
     }
 
-    void draw(sf::RenderWindow& window) override {
-        GameObject::draw(window);
-        for (const auto& bullet : bullets) {
-            bullet->draw(window);
-        }
-    }
+    void setInput(const PlayerInput& newInput) { input = newInput; }
 
     void shoot() {
         sf::Vector2f bulletPos = position + sf::Vector2f(sprite->getGlobalBounds().width / 2, 0);
         
         if (hasPowerUp && activePowerUp == PowerUpType::SpreadShot) {
             // Create 3 bullets in a spread pattern
-            bullets.push_back(std::make_unique<Bullet>(bulletPos, 500.f));
+            bullets.push_back(std::make_unique<Bullet>(bulletPos, 500.f, bulletTexture));
             bullets.back()->setVelocity(sf::Vector2f(-100.f, -500.f));
             
-            bullets.push_back(std::make_unique<Bullet>(bulletPos, 500.f));
+            bullets.push_back(std::make_unique<Bullet>(bulletPos, 500.f, bulletTexture));
             bullets.back()->setVelocity(sf::Vector2f(0.f, -500.f));
             
-            bullets.push_back(std::make_unique<Bullet>(bulletPos, 500.f));
+            bullets.push_back(std::make_unique<Bullet>(bulletPos, 500.f, bulletTexture));
             bullets.back()->setVelocity(sf::Vector2f(100.f, -500.f));
         } else {
-            bullets.push_back(std::make_unique<Bullet>(bulletPos, 500.f));
+            bullets.push_back(std::make_unique<Bullet>(bulletPos, 500.f, bulletTexture));
         }
     }
 
@@ -376,6 +518,8 @@ public:
         return bullets;
     }
 
+    void removeBullet(std::size_t index) { swapRemove(bullets, index); }
+
     int getLives() const { return lives; }
     
     void loseLife() {
@@ -390,58 +534,45 @@ public:
     bool isAlive() const { return lives > 0; }
 };
 
-class Enemy : public GameObject {
-protected:
+struct EnemyStats {
+    float healthPoints;
+    float scale;
+    float speedMultiplier;
+    sf::Color color;
+    int scoreValue;
+};
+
+// Indexed by EnemyType
+static const EnemyStats kEnemyStats[] = {
+    {1.f, 0.8f, 1.0f, sf::Color::White, 100},          // Basic
+    {1.f, 0.6f, 1.5f, sf::Color(150, 255, 150), 150},  // Scout: light green
+    {3.f, 1.0f, 0.7f, sf::Color(255, 150, 150), 200},  // Tank: light red
+    {1.f, 0.8f, 1.0f, sf::Color(150, 150, 255), 175},  // Zigzag: light blue
+    {1.f, 0.7f, 1.2f, sf::Color(255, 200, 120), 175},  // SineDive: orange
+    {2.f, 0.8f, 0.8f, sf::Color(255, 130, 255), 250},  // Homing: magenta
+    {1.f, 0.7f, 0.9f, sf::Color(130, 255, 255), 125},  // Formation: cyan
+};
+static_assert(std::size(kEnemyStats) == static_cast<std::size_t>(EnemyType::Count),
+              "kEnemyStats needs one row per EnemyType");
+
+// Enemy state shared by every behavior. Movement lives in the behavior
+// policies below, not here.
+class Enemy final : public GameObject {
+private:
     EnemyType type;
     float healthPoints;
-    float zigzagTimer = 0.f;
-    float zigzagFrequency = 2.f;
-    float originalX;
+
+    const EnemyStats& stats() const { return kEnemyStats[static_cast<int>(type)]; }
 
 public:
-    Enemy(const sf::Vector2f& pos, float spd, EnemyType t) 
-        : GameObject(pos, spd), type(t), originalX(pos.x) {
-        texture.loadFromFile("enemy.png");
+    Enemy(const sf::Vector2f& pos, float spd, EnemyType t, const sf::Texture& texture) 
+        : GameObject(pos, spd), type(t) {
         sprite = std::make_unique<sf::Sprite>(texture);
-        
-        switch(type) {
-            case EnemyType::Basic:
-                healthPoints = 1.f;
-                sprite->setScale(0.8f, 0.8f);
-                velocity = sf::Vector2f(0.f, speed);
-                break;
-            case EnemyType::Scout:
-                healthPoints = 1.f;
-                sprite->setScale(0.6f, 0.6f);
-                speed *= 1.5f;
-                velocity = sf::Vector2f(0.f, speed);
-                sprite->setColor(sf::Color(150, 255, 150));  // Light green
-                break;
-            case EnemyType::Tank:
-                healthPoints = 3.f;
-                sprite->setScale(1.0f, 1.0f);
-                speed *= 0.7f;
-                velocity = sf::Vector2f(0.f, speed);
-                sprite->setColor(sf::Color(255, 150, 150));  // Light red
-                break;
-            case EnemyType::Zigzag:
-                healthPoints = 1.f;
-                sprite->setScale(0.8f, 0.8f);
-                velocity = sf::Vector2f(0.f, speed);
-                sprite->setColor(sf::Color(150, 150, 255));  // Light blue
-                break;
-        }
-    }
-
-    void update(float deltaTime) override {
-        if (type == EnemyType::Zigzag) {
-            zigzagTimer += deltaTime;
-            float xOffset = std::sin(zigzagTimer * zigzagFrequency) * 100.f;
-            position.x = originalX + xOffset;
-            position.y += velocity.y * deltaTime;
-        } else {
-            position += velocity * deltaTime;
-        }
+        sprite->setScale(stats().scale, stats().scale);
+        sprite->setColor(stats().color);
+        healthPoints = stats().healthPoints;
+        speed *= stats().speedMultiplier;
+        velocity = sf::Vector2f(0.f, speed);
     }
 
     bool hit() {
@@ -449,149 +580,1289 @@ public:
         return healthPoints <= 0;
     }
 
-    int getScoreValue() const {
-        switch(type) {
-            case EnemyType::Scout: return 150;
-            case EnemyType::Tank: return 200;
-            case EnemyType::Zigzag: return 175;
-            default: return 100;
+    EnemyType getType() const { return type; }
+
+    int getScoreValue() const { return stats().scoreValue; }
+
+    bool isOffScreen(const Playfield& field) const {
+        return field.isBelow(position.y);
+    }
+};
+
+// What behaviors may look at besides the enemy itself
+struct EnemyContext {
+    sf::Vector2f playerPosition;
+};
+
+// Enemy behaviors as compile-time policies. Each provides a State, an init()
+// that builds it at spawn and a step() that moves one enemy. Swarms store one
+// behavior's enemies contiguously and call step() directly, so the per-frame
+// loop has no type switch and no virtual call.
+struct LinearMotion {
+    struct State {};
+
+    static State init(const Enemy&) { return {}; }
+
+    static void step(Enemy& enemy, State&, float deltaTime, const EnemyContext&) {
+        enemy.update(deltaTime);
+    }
+};
+
+struct ZigzagMotion {
+    struct State {
+        float timer;
+        float originX;
+    };
+
+    static State init(const Enemy& enemy) { return {0.f, enemy.getPosition().x}; }
+
+    static void step(Enemy& enemy, State& state, float deltaTime, const EnemyContext&) {
+        state.timer += deltaTime;
+        sf::Vector2f position = enemy.getPosition();
+        position.x = state.originX + std::sin(state.timer * 2.f) * 100.f;
+        position.y += enemy.getVelocity().y * deltaTime;
+        enemy.setPosition(position);
+    }
+};
+
+// Weaves gently while surging forward and easing off
+struct SineDiveMotion {
+    struct State {
+        float timer;
+        float originX;
+    };
+
+    static State init(const Enemy& enemy) { return {0.f, enemy.getPosition().x}; }
+
+    static void step(Enemy& enemy, State& state, float deltaTime, const EnemyContext&) {
+        state.timer += deltaTime;
+        sf::Vector2f position = enemy.getPosition();
+        position.x = state.originX + std::sin(state.timer * 1.5f) * 60.f;
+        position.y += enemy.getVelocity().y * (1.f + 0.8f * std::sin(state.timer * 3.f)) * deltaTime;
+        enemy.setPosition(position);
+    }
+};
+
+// Drifts sideways toward the player at a limited turn speed
+struct HomingMotion {
+    static constexpr float kLateralSpeed = 80.f;
+
+    struct State {};
+
+    static State init(const Enemy&) { return {}; }
+
+    static void step(Enemy& enemy, State&, float deltaTime, const EnemyContext& context) {
+        sf::Vector2f position = enemy.getPosition();
+        float maxStep = kLateralSpeed * deltaTime;
+        position.x += std::max(-maxStep, std::min(maxStep, context.playerPosition.x - position.x));
+        position.y += enemy.getVelocity().y * deltaTime;
+        enemy.setPosition(position);
+    }
+};
+
+// Slides side to side. A formation's ships all spawn on the same tick, so
+// their timers, and their sway, stay in lockstep.
+struct FormationMotion {
+    static constexpr float kSwayAmplitude = 60.f;
+
+    struct State {
+        float timer;
+        float originX;
+    };
+
+    static State init(const Enemy& enemy) { return {0.f, enemy.getPosition().x}; }
+
+    static void step(Enemy& enemy, State& state, float deltaTime, const EnemyContext&) {
+        state.timer += deltaTime;
+        sf::Vector2f position = enemy.getPosition();
+        position.x = state.originX + std::sin(state.timer * 1.2f) * kSwayAmplitude;
+        position.y += enemy.getVelocity().y * deltaTime;
+        enemy.setPosition(position);
+    }
+};
+
+// All enemies of one behavior, with their behavior state in a parallel array
+template <typename Behavior>
+class EnemySwarm {
+public:
+    std::vector<Enemy> members;
+    std::vector<typename Behavior::State> states;
+
+    Enemy& spawn(Enemy&& enemy) {
+        members.push_back(std::move(enemy));
+        states.push_back(Behavior::init(members.back()));
+        return members.back();
+    }
+
+    void update(float deltaTime, const EnemyContext& context) {
+        for (std::size_t i = 0; i < members.size(); ++i) {
+            Behavior::step(members[i], states[i], deltaTime, context);
         }
     }
 
-    bool isOffScreen() const {
-        return position.y > 650.f;
+    void remove(std::size_t index) {
+        swapRemove(members, index);
+        swapRemove(states, index);
     }
 };
 
-class Game {
+// One swarm per behavior. Adding a behavior means adding it to the type
+// list where the roster is declared; no existing loop changes.
+template <typename... Behaviors>
+class EnemyRoster {
 private:
-    sf::RenderWindow window;
-    std::unique_ptr<Player> player;
-    std::vector<std::unique_ptr<Enemy>> enemies;
-    std::vector<std::unique_ptr<PowerUp>> powerUps;
-    std::vector<Star> stars;
-    ParticleSystem particles;
-    sf::Clock clock;
-    float enemySpawnTimer = 0.f;
-    float enemySpawnInterval = 1.5f;
-    float powerUpSpawnTimer = 0.f;
-    float powerUpSpawnInterval = 15.f;
-    std::mt19937 rng{std::random_device{}()};
-    int score = 0;
-    int wave = 1;
-    sf::Font font;
-    sf::Text scoreText;
-    sf::Text livesText;
-    sf::Text waveText;
-    float screenShakeTime = 0.f;
-    sf::Vector2f screenShakeOffset;
+    std::tuple<EnemySwarm<Behaviors>...> swarms;
 
-    void initStars() {
-        std::uniform_real_distribution<float> xDist(0.f, 800.f);
-        std::uniform_real_distribution<float> yDist(0.f, 600.f);
-        std::uniform_real_distribution<float> speedDist(30.f, 120.f);
-        
-        // Create three layers of stars
-        for (int i = 0; i < 80; ++i) {
-            stars.emplace_back(xDist(rng), yDist(rng), 1.f, speedDist(rng) * 0.5f);
+    template <typename F, std::size_t... Indices>
+    void forEachSwarm(F&& f, std::index_sequence<Indices...>) {
+        (f(std::get<Indices>(swarms), Indices), ...);
+    }
+
+public:
+    template <typename Behavior>
+    EnemySwarm<Behavior>& swarm() { return std::get<EnemySwarm<Behavior>>(swarms); }
+
+    // Calls f(swarm, swarmIndex) for every swarm
+    template <typename F>
+    void forEachSwarm(F&& f) {
+        forEachSwarm(f, std::index_sequence_for<Behaviors...>());
+    }
+
+    void update(float deltaTime, const EnemyContext& context) {
+        forEachSwarm([&](auto& swarm, std::size_t) { swarm.update(deltaTime, context); });
+    }
+
+    void remove(std::size_t swarmIndex, std::size_t index) {
+        forEachSwarm([&](auto& swarm, std::size_t current) {
+            if (current == swarmIndex) swarm.remove(index);
+        });
+    }
+};
+
+using Enemies = EnemyRoster<LinearMotion, ZigzagMotion, SineDiveMotion, HomingMotion, FormationMotion>;
+
+// Recorded session: the RNG seed, the playfield size and one packed
+// PlayerInput per frame. Replays always run at a fixed timestep so they
+// reproduce exactly.
+struct Replay {
+    static constexpr std::uint32_t kMagic = 0x50525353;  // "SSRP"
+    static constexpr std::uint32_t kVersion = 2;
+
+    std::uint32_t seed = 0;
+    Playfield playfield;
+    std::vector<std::uint8_t> inputs;
+
+    bool save(const std::string& path) const {
+        std::ofstream out(path, std::ios::binary);
+        std::uint32_t header[4] = {kMagic, kVersion, seed, static_cast<std::uint32_t>(inputs.size())};
+        float bounds[2] = {playfield.width, playfield.height};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(bounds), sizeof(bounds));
+        out.write(reinterpret_cast<const char*>(inputs.data()), inputs.size());
+        return static_cast<bool>(out);
+    }
+
+    bool load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::uint32_t header[4];
+        float bounds[2];
+        if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+            header[0] != kMagic || header[1] != kVersion ||
+            !in.read(reinterpret_cast<char*>(bounds), sizeof(bounds))) {
+            return false;
         }
-        for (int i = 0; i < 40; ++i) {
-            stars.emplace_back(xDist(rng), yDist(rng), 2.f, speedDist(rng));
+        seed = header[2];
+        playfield.width = bounds[0];
+        playfield.height = bounds[1];
+        if (!playfield.isValid()) {
+            return false;
         }
-        for (int i = 0; i < 15; ++i) {
-            stars.emplace_back(xDist(rng), yDist(rng), 3.f, speedDist(rng) * 1.5f);
+
+        // Don't trust the count in a truncated or corrupt file
+        std::streamoff inputStart = in.tellg();
+        in.seekg(0, std::ios::end);
+        std::streamoff available = in.tellg() - inputStart;
+        if (available < static_cast<std::streamoff>(header[3])) {
+            return false;
         }
-    } 
-    void addScreenShake(float duration = 0.2f, float intensity = 5.f) {
-        screenShakeTime = duration;
-        std::uniform_real_distribution<float> shakeDist(-intensity, intensity);
-        screenShakeOffset = sf::Vector2f(shakeDist(rng), shakeDist(rng));
+        in.seekg(inputStart);
+        inputs.resize(header[3]);
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(inputs.data()), inputs.size()));
     }
-    
-    void updateScreenShake(float deltaTime) {
-        if (screenShakeTime > 0) {
-            screenShakeTime -= deltaTime;
-            if (screenShakeTime <= 0) {
-                screenShakeOffset = sf::Vector2f(0, 0);
-            } else {
-                std::uniform_real_distribution<float> shakeDist(-5.f, 5.f);
-                screenShakeOffset = sf::Vector2f(shakeDist(rng), shakeDist(rng));
-            }
+};
+
+// Minimal animated GIF encoder: fixed 3-3-2 RGB palette, LZW-compressed frames.
+class GifWriter {
+private:
+    static constexpr int kMinCodeSize = 8;
+    static constexpr int kClearCode = 1 << kMinCodeSize;
+    static constexpr int kEndCode = kClearCode + 1;
+    static constexpr int kMaxCode = 4095;
+
+    std::ofstream out;
+    unsigned width = 0;
+    unsigned height = 0;
+    std::vector<std::uint8_t> indices;
+    std::vector<std::uint16_t> codeTable;  // (prefix code << 8 | index) -> code, 0 = unused
+    std::vector<std::uint8_t> block;
+    std::uint32_t bitBuffer = 0;
+    int bitCount = 0;
+
+    void writeByte(std::uint8_t value) { out.put(static_cast<char>(value)); }
+
+    void writeWord(std::uint16_t value) {
+        writeByte(value & 0xFF);
+        writeByte(value >> 8);
+    }
+
+    void flushBlock() {
+        if (block.empty()) return;
+        writeByte(static_cast<std::uint8_t>(block.size()));
+        out.write(reinterpret_cast<const char*>(block.data()), block.size());
+        block.clear();
+    }
+
+    void pushByte(std::uint8_t value) {
+        block.push_back(value);
+        if (block.size() == 255) {
+            flushBlock();
         }
     }
-    
+
+    void emitCode(int code, int codeSize) {
+        bitBuffer |= static_cast<std::uint32_t>(code) << bitCount;
+        bitCount += codeSize;
+        while (bitCount >= 8) {
+            pushByte(bitBuffer & 0xFF);
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
 public:
-    Game() : window(sf::VideoMode(800, 600), "Space Shooter"), particles(rng) {
-        window.setFramerateLimit(60);
-        player = std::make_unique<Player>(sf::Vector2f(400.f, 500.f), 300.f);
-        
-        if (!font.loadFromFile("/System/Library/Fonts/Supplemental/Arial.ttf")) {
-            font.loadFromFile("/System/Library/Fonts/Helvetica.ttc");
+    bool open(const std::string& path, unsigned w, unsigned h) {
+        out.open(path, std::ios::binary);
+        if (!out) return false;
+        width = w;
+        height = h;
+        indices.resize(static_cast<std::size_t>(width) * height);
+        codeTable.resize((kMaxCode + 1) << 8);
+
+        out.write("GIF89a", 6);
+        writeWord(static_cast<std::uint16_t>(width));
+        writeWord(static_cast<std::uint16_t>(height));
+        writeByte(0xF7);  // 256-entry global color table
+        writeByte(0);
+        writeByte(0);
+        for (int i = 0; i < 256; ++i) {
+            writeByte(static_cast<std::uint8_t>(((i >> 5) & 7) * 255 / 7));
+            writeByte(static_cast<std::uint8_t>(((i >> 2) & 7) * 255 / 7));
+            writeByte(static_cast<std::uint8_t>((i & 3) * 255 / 3));
         }
-        
-        scoreText.setFont(font);
-        scoreText.setCharacterSize(24);
-        scoreText.setFillColor(sf::Color::White);
-        scoreText.setPosition(10, 10);
-        
-        livesText.setFont(font);
-        livesText.setCharacterSize(24);
-        livesText.setFillColor(sf::Color::White);
-        livesText.setPosition(10, 40);
-        
-        waveText.setFont(font);
-        waveText.setCharacterSize(24);
-        waveText.setFillColor(sf::Color::White);
-        waveText.setPosition(10, 70);
-        
-        initStars();
-        updateHUD();
+
+        // Loop forever
+        out.write("\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 19);
+        return static_cast<bool>(out);
     }
-    
-    void run() {
-        while (window.isOpen()) {
-            handleEvents();
-            if (player->isAlive()) {
-                update();
+
+    void addFrame(const std::uint8_t* rgba, bool bottomUp, std::uint16_t delayCentiseconds) {
+        for (unsigned y = 0; y < height; ++y) {
+            unsigned sourceRow = bottomUp ? height - 1 - y : y;
+            const std::uint8_t* pixel = rgba + static_cast<std::size_t>(sourceRow) * width * 4;
+            std::uint8_t* row = &indices[static_cast<std::size_t>(y) * width];
+            for (unsigned x = 0; x < width; ++x, pixel += 4) {
+                row[x] = (pixel[0] & 0xE0) | ((pixel[1] & 0xE0) >> 3) | (pixel[2] >> 6);
             }
-            render();
         }
+
+        // Graphic control extension, then image descriptor
+        out.write("\x21\xF9\x04\x00", 4);
+        writeWord(delayCentiseconds);
+        writeByte(0);
+        writeByte(0);
+        writeByte(0x2C);
+        writeWord(0);
+        writeWord(0);
+        writeWord(static_cast<std::uint16_t>(width));
+        writeWord(static_cast<std::uint16_t>(height));
+        writeByte(0);
+
+        writeByte(kMinCodeSize);
+        std::fill(codeTable.begin(), codeTable.end(), 0);
+        int codeSize = kMinCodeSize + 1;
+        int maxCode = kEndCode;
+        emitCode(kClearCode, codeSize);
+
+        int current = indices[0];
+        for (std::size_t i = 1; i < indices.size(); ++i) {
+            std::uint8_t next = indices[i];
+            std::uint16_t& entry = codeTable[(current << 8) | next];
+            if (entry) {
+                current = entry;
+                continue;
+            }
+            emitCode(current, codeSize);
+            entry = static_cast<std::uint16_t>(++maxCode);
+            if (maxCode >= (1 << codeSize)) {
+                codeSize++;
+            }
+            if (maxCode == kMaxCode) {
+                emitCode(kClearCode, codeSize);
+                std::fill(codeTable.begin(), codeTable.end(), 0);
+                codeSize = kMinCodeSize + 1;
+                maxCode = kEndCode;
+            }
+            current = next;
+        }
+        emitCode(current, codeSize);
+        emitCode(kEndCode, codeSize);
+        if (bitCount > 0) {
+            pushByte(bitBuffer & 0xFF);
+        }
+        bitBuffer = 0;
+        bitCount = 0;
+        flushBlock();
+        writeByte(0);
     }
-    
+
+    void close() {
+        if (out.is_open()) {
+            writeByte(0x3B);
+            out.close();
+        }
+    }
+};
+
+enum class CaptureFormat {
+    PngSequence,
+    Gif
+};
+
+// Records frames from an offscreen render target without stalling the game
+// thread. glReadPixels goes into a ring of pixel buffer objects, and each
+// buffer is only mapped once the ring wraps around, by which time the GPU has
+// long finished the copy. PNG/GIF encoding happens on a background thread.
+class FrameRecorder {
 private:
-    void handleEvents() {
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed) {
-                window.close();
+    static constexpr int kRingSize = 3;
+    static constexpr std::size_t kMaxFramesInFlight = 8;
+
+    unsigned width;
+    unsigned height;
+    CaptureFormat format;
+    std::string outputPath;
+    unsigned frameStride;
+    bool dropWhenBusy;
+    GLuint pixelBuffers[kRingSize] = {};
+    std::uint64_t framesSeen = 0;
+    std::uint64_t framesIssued = 0;
+    std::uint64_t framesDropped = 0;
+    bool opened = false;
+    bool finished = false;
+
+    std::vector<std::vector<std::uint8_t>> freeFrames;
+    std::deque<std::vector<std::uint8_t>> queuedFrames;
+    std::size_t framesAllocated = 0;
+    bool stopping = false;
+    std::mutex queueMutex;
+    std::condition_variable frameQueued;
+    std::condition_variable frameReleased;
+    std::thread encoderThread;
+    GifWriter gif;
+
+    void collect(int slot) {
+        std::vector<std::uint8_t> frame;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            if (freeFrames.empty() && framesAllocated >= kMaxFramesInFlight) {
+                if (dropWhenBusy) {
+                    // The encoder is behind; losing a frame beats a hitch in gameplay
+                    ++framesDropped;
+                    return;
+                }
+                frameReleased.wait(lock, [this] { return !freeFrames.empty(); });
+            }
+            if (!freeFrames.empty()) {
+                frame = std::move(freeFrames.back());
+                freeFrames.pop_back();
+            } else {
+                frame.resize(static_cast<std::size_t>(width) * height * 4);
+                ++framesAllocated;
             }
         }
-    }
 
-    void spawnPowerUp() {
-        std::uniform_real_distribution<float> xDist(50.f, 750.f);
-        std::uniform_int_distribution<int> typeDist(0, 2);
-        
-        PowerUpType type;
-        switch(typeDist(rng)) {
-            case 0: type = PowerUpType::SpreadShot; break;
-            case 1: type = PowerUpType::RapidFire; break;
-            default: type = PowerUpType::Shield; break;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+        const void* pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (pixels) {
+            std::memcpy(frame.data(), pixels, frame.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
         }
-        
-        powerUps.push_back(std::make_unique<PowerUp>(
-            sf::Vector2f(xDist(rng), -50.f), type));
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            queuedFrames.push_back(std::move(frame));
+        }
+        frameQueued.notify_one();
     }
-    
-    void spawnEnemy() {
-        std::uniform_real_distribution<float> xDist(50.f, 750.f);
-        std::uniform_int_distribution<int> typeDist(0, 3);
+
+    void encodeFrames() {
+        std::uint64_t frameNumber = 0;
+        while (true) {
+            std::vector<std::uint8_t> frame;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                frameQueued.wait(lock, [this] { return stopping || !queuedFrames.empty(); });
+                if (queuedFrames.empty()) break;
+                frame = std::move(queuedFrames.front());
+                queuedFrames.pop_front();
+            }
+
+            if (format == CaptureFormat::Gif) {
+                gif.addFrame(frame.data(), true, kGifDelays[frameNumber % 3]);
+            } else {
+                sf::Image image;
+                image.create(width, height, frame.data());
+                image.flipVertically();  // OpenGL rows are bottom-up
+                char name[32];
+                std::snprintf(name, sizeof(name), "frame_%05llu.png",
+                              static_cast<unsigned long long>(frameNumber));
+                image.saveToFile(outputPath + "/" + name);
+            }
+            ++frameNumber;
+
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                freeFrames.push_back(std::move(frame));
+            }
+            frameReleased.notify_one();
+        }
+        gif.close();
+    }
+
+public:
+    // A GIF records every other frame, 1/30 s each. GIF delays are whole
+    // 1/100 s, so they cycle 3, 3, 4 to keep real-time speed.
+    static constexpr std::uint16_t kGifDelays[3] = {3, 3, 4};
+
+    // Check isOpen() before capturing; nothing is recorded if the output
+    // could not be created.
+    FrameRecorder(unsigned w, unsigned h, CaptureFormat fmt, const std::string& path, bool dropFrames)
+        : width(w), height(h), format(fmt), outputPath(path),
+          frameStride(fmt == CaptureFormat::Gif ? 2 : 1), dropWhenBusy(dropFrames) {
+        if (format == CaptureFormat::Gif) {
+            if (!gif.open(outputPath, width, height)) {
+                std::cerr << "Could not open " << outputPath << " for writing\n";
+                return;
+            }
+        } else {
+            std::error_code error;
+            std::filesystem::create_directories(outputPath, error);
+            if (error || !std::filesystem::is_directory(outputPath, error)) {
+                std::cerr << "Could not create capture directory " << outputPath
+                          << (error ? ": " + error.message() : "") << "\n";
+                return;
+            }
+        }
+
+        glGenBuffers(kRingSize, pixelBuffers);
+        for (GLuint buffer : pixelBuffers) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4,
+                         nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        encoderThread = std::thread(&FrameRecorder::encodeFrames, this);
+        opened = true;
+    }
+
+    bool isOpen() const { return opened; }
+
+    ~FrameRecorder() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        frameQueued.notify_one();
+        if (encoderThread.joinable()) {
+            encoderThread.join();
+        }
+    }
+
+    // Call after target.display(). Queues an asynchronous readback and hands
+    // the oldest completed one to the encoder.
+    void capture(sf::RenderTexture& target) {
+        if (finished || framesSeen++ % frameStride != 0 || !target.setActive(true)) {
+            return;
+        }
+
+        int slot = static_cast<int>(framesIssued % kRingSize);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        ++framesIssued;
+
+        if (framesIssued >= kRingSize) {
+            collect(static_cast<int>(framesIssued % kRingSize));
+        }
+    }
+
+    // Drains readbacks still in flight and waits for the encoder to write them.
+    void finish(sf::RenderTexture& target) {
+        if (finished) return;
+        finished = true;
+
+        if (target.setActive(true)) {
+            std::uint64_t first = framesIssued >= kRingSize ? framesIssued - kRingSize + 1 : 0;
+            for (std::uint64_t frame = first; frame < framesIssued; ++frame) {
+                collect(static_cast<int>(frame % kRingSize));
+            }
+            glDeleteBuffers(kRingSize, pixelBuffers);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        frameQueued.notify_one();
+        if (encoderThread.joinable()) {
+            encoderThread.join();
+        }
+
+        if (framesDropped > 0) {
+            std::cerr << "Capture dropped " << framesDropped << " frames\n";
+        }
+    }
+};
+
+// Render layers, so golden images can isolate what changed
+namespace RenderLayer {
+    enum : unsigned {
+        Stars = 1 << 0,
+        Particles = 1 << 1,
+        Player = 1 << 2,
+        Enemies = 1 << 3,
+        PowerUps = 1 << 4,
+        Hud = 1 << 5,
+        GameOver = 1 << 6,
+        All = (1 << 7) - 1
+    };
+}
+
+struct GoldenLayer {
+    unsigned mask;
+    const char* name;
+};
+
+static const GoldenLayer kGoldenLayers[] = {
+    {RenderLayer::All, "all"},
+    {RenderLayer::Stars, "stars"},
+    {RenderLayer::Particles, "particles"},
+    {RenderLayer::Player, "player"},
+    {RenderLayer::Enemies, "enemies"},
+    {RenderLayer::PowerUps, "powerups"},
+    {RenderLayer::Hud, "hud"},
+    {RenderLayer::GameOver, "gameover"},
+};
+
+// Counts pixels where any RGBA channel differs by more than tolerance,
+// 4 pixels per iteration where SSE2 or NEON is available.
+static std::size_t countDifferingPixels(const std::uint8_t* a, const std::uint8_t* b,
+                                        std::size_t pixelCount, std::uint8_t tolerance) {
+    std::size_t differing = 0;
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(tolerance));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= pixelCount; i += 4) {
+        __m128i pa = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i * 4));
+        __m128i pb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i * 4));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(pa, pb), _mm_subs_epu8(pb, pa));
+        __m128i over = _mm_subs_epu8(diff, limit);  // Nonzero where diff > tolerance
+        __m128i same = _mm_cmpeq_epi32(over, zero);
+        differing += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(same)));
+    }
+#elif defined(__aarch64__)
+    const uint8x16_t limit = vdupq_n_u8(tolerance);
+    uint32x4_t counts = vdupq_n_u32(0);
+    for (; i + 4 <= pixelCount; i += 4) {
+        uint8x16_t diff = vabdq_u8(vld1q_u8(a + i * 4), vld1q_u8(b + i * 4));
+        uint32x4_t over = vreinterpretq_u32_u8(vcgtq_u8(diff, limit));
+        counts = vsubq_u32(counts, vtstq_u32(over, over));  // Set lanes are -1
+    }
+    differing = vaddvq_u32(counts);
+#endif
+    for (; i < pixelCount; ++i) {
+        const std::uint8_t* pa = a + i * 4;
+        const std::uint8_t* pb = b + i * 4;
+        for (int c = 0; c < 4; ++c) {
+            if (std::abs(pa[c] - pb[c]) > tolerance) {
+                ++differing;
+                break;
+            }
+        }
+    }
+    return differing;
+}
+
+// Golden images for a seeded run, stored as DIR/frame_NNNNN_LAYER.png.
+// A frame matches when at most maxDifferingFraction of its pixels differ by
+// more than channelTolerance, which absorbs rasterizer rounding and
+// antialiasing noise between drivers but not a missing or moved sprite.
+class GoldenImageSet {
+private:
+    std::string directory;
+    std::vector<std::size_t> frames;
+    std::vector<std::size_t> reached;
+    bool updating;
+    std::uint8_t channelTolerance = 8;
+    float maxDifferingFraction = 0.001f;
+    int checked = 0;
+    int failed = 0;
+
+    std::string pathFor(std::size_t frame, const char* layer) const {
+        char name[64];
+        std::snprintf(name, sizeof(name), "frame_%05zu_%s.png", frame, layer);
+        return directory + "/" + name;
+    }
+
+public:
+    GoldenImageSet(const std::string& dir, const std::vector<std::size_t>& checkpoints, bool update)
+        : directory(dir), frames(checkpoints), updating(update) {
+        if (updating) {
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+            if (error) {
+                std::cerr << "Could not create " << directory << ": " << error.message() << "\n";
+            }
+        }
+    }
+
+    // The seed is stored next to the images, so a check always simulates the
+    // same session the images were made from
+    static constexpr std::uint32_t kDefaultSeed = 1;
+
+    static bool saveSeed(const std::string& dir, std::uint32_t seed) {
+        std::error_code error;
+        std::filesystem::create_directories(dir, error);
+        std::ofstream out(dir + "/seed.txt");
+        out << seed << "\n";
+        return static_cast<bool>(out);
+    }
+
+    static bool loadSeed(const std::string& dir, std::uint32_t& seed) {
+        std::ifstream in(dir + "/seed.txt");
+        return static_cast<bool>(in >> seed);
+    }
+
+    bool isCheckpoint(std::size_t frame) const {
+        return std::find(frames.begin(), frames.end(), frame) != frames.end();
+    }
+
+    void check(std::size_t frame, const char* layer, const sf::Image& actual) {
+        std::string path = pathFor(frame, layer);
+        ++checked;
+        if (std::find(reached.begin(), reached.end(), frame) == reached.end()) {
+            reached.push_back(frame);
+        }
+        if (updating) {
+            if (!actual.saveToFile(path)) {
+                std::cerr << "Could not write " << path << "\n";
+                ++failed;
+            }
+            return;
+        }
+
+        sf::Image expected;
+        if (!expected.loadFromFile(path)) {
+            std::cerr << "FAIL " << path << ": missing golden image\n";
+            ++failed;
+            return;
+        }
+        if (expected.getSize() != actual.getSize()) {
+            std::cerr << "FAIL " << path << ": size mismatch\n";
+            ++failed;
+            return;
+        }
+
+        std::size_t pixelCount = static_cast<std::size_t>(actual.getSize().x) * actual.getSize().y;
+        std::size_t differing = countDifferingPixels(expected.getPixelsPtr(), actual.getPixelsPtr(),
+                                                     pixelCount, channelTolerance);
+        if (differing > pixelCount * maxDifferingFraction) {
+            std::cerr << "FAIL " << path << ": " << differing << " of " << pixelCount
+                      << " pixels differ\n";
+            actual.saveToFile(directory + "/actual_" + std::filesystem::path(path).filename().string());
+            ++failed;
+        }
+    }
+
+    // Checkpoints the session ended before reaching
+    std::vector<std::size_t> missedCheckpoints() const {
+        std::vector<std::size_t> missed;
+        for (std::size_t frame : frames) {
+            if (std::find(reached.begin(), reached.end(), frame) == reached.end()) {
+                missed.push_back(frame);
+            }
+        }
+        return missed;
+    }
+
+    // A run that never reached a checkpoint verified nothing, so it fails too
+    bool passed() const { return failed == 0 && checked > 0 && missedCheckpoints().empty(); }
+
+    void printSummary() const {
+        std::cout << (updating ? "Wrote " : "Checked ") << checked << " golden images";
+        if (failed > 0) {
+            std::cout << ", " << failed << " failed";
+        }
+        std::cout << "\n";
+        for (std::size_t frame : missedCheckpoints()) {
+            std::cerr << "FAIL frame " << frame << ": session ended before this checkpoint\n";
+        }
+        if (checked == 0) {
+            std::cerr << "FAIL no golden images were checked\n";
+        }
+    }
+};
+
+enum class TelemetryEventType : std::uint8_t {
+    EnemySpawn,
+    EnemyHit,
+    EnemyKill,
+    EnemyEscape,
+    PowerUpPickup,
+    WaveChange,
+    PowerUpSpawn,
+    PowerUpEscape
+};
+
+static const char* telemetryEventName(TelemetryEventType type) {
+    switch(type) {
+        case TelemetryEventType::EnemySpawn: return "enemy_spawn";
+        case TelemetryEventType::EnemyHit: return "enemy_hit";
+        case TelemetryEventType::EnemyKill: return "enemy_kill";
+        case TelemetryEventType::EnemyEscape: return "enemy_escape";
+        case TelemetryEventType::PowerUpPickup: return "powerup_pickup";
+        case TelemetryEventType::WaveChange: return "wave_change";
+        case TelemetryEventType::PowerUpSpawn: return "powerup_spawn";
+        case TelemetryEventType::PowerUpEscape: return "powerup_escape";
+    }
+    return "unknown";
+}
+
+// One gameplay event. Fixed-size and trivially copyable: the binary log is a
+// header followed by these records back to back.
+struct TelemetryEvent {
+    std::uint32_t frame;
+    std::uint32_t entityId;
+    TelemetryEventType type;
+    std::uint8_t kind;     // EnemyType or PowerUpType, where relevant
+    std::uint16_t wave;
+    float x;
+    float y;
+    std::int32_t value;    // Score for kills, lives left for escapes, wave for wave changes
+};
+static_assert(sizeof(TelemetryEvent) == 24, "telemetry log layout changed");
+
+// Single-producer single-consumer ring buffer. The game thread pushes, the
+// writer thread pops; neither ever blocks or allocates.
+template <typename T, std::size_t Capacity>
+class SpscRing {
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    std::array<T, Capacity> slots;
+    alignas(64) std::atomic<std::size_t> head{0};  // Next slot to read
+    alignas(64) std::atomic<std::size_t> tail{0};  // Next slot to write
+
+public:
+    bool push(const T& item) {
+        std::size_t writeIndex = tail.load(std::memory_order_relaxed);
+        if (writeIndex - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[writeIndex & (Capacity - 1)] = item;
+        tail.store(writeIndex + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::size_t pop(T* out, std::size_t maxCount) {
+        std::size_t readIndex = head.load(std::memory_order_relaxed);
+        std::size_t available = tail.load(std::memory_order_acquire) - readIndex;
+        std::size_t count = std::min(available, maxCount);
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = slots[(readIndex + i) & (Capacity - 1)];
+        }
+        head.store(readIndex + count, std::memory_order_release);
+        return count;
+    }
+};
+
+// Streams gameplay events to a binary log. record() only copies into the
+// ring; a background thread drains it and does all the file I/O.
+class TelemetryLog {
+public:
+    static constexpr std::uint32_t kMagic = 0x4C545353;  // "SSTL"
+    static constexpr std::uint32_t kVersion = 1;
+
+private:
+    static constexpr std::size_t kCapacity = 1 << 14;
+    static constexpr std::size_t kBatchSize = 256;
+
+    SpscRing<TelemetryEvent, kCapacity> ring;
+    std::ofstream out;
+    std::atomic<bool> running{true};
+    std::atomic<std::uint64_t> dropped{0};
+    std::thread writerThread;
+
+    void drain() {
+        TelemetryEvent batch[kBatchSize];
+        while (true) {
+            // Read the flag first so events pushed before stop() are still written
+            bool stopping = !running.load(std::memory_order_acquire);
+            std::size_t count;
+            while ((count = ring.pop(batch, kBatchSize)) > 0) {
+                out.write(reinterpret_cast<const char*>(batch), count * sizeof(TelemetryEvent));
+            }
+            if (stopping) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        out.flush();
+    }
+
+public:
+    explicit TelemetryLog(const std::string& path) : out(path, std::ios::binary) {
+        std::uint32_t header[3] = {kMagic, kVersion, sizeof(TelemetryEvent)};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        writerThread = std::thread(&TelemetryLog::drain, this);
+    }
+
+    ~TelemetryLog() {
+        running.store(false, std::memory_order_release);
+        writerThread.join();
+        if (dropped > 0) {
+            std::cerr << "Telemetry dropped " << dropped << " events\n";
+        }
+    }
+
+    bool isOpen() const { return out.is_open(); }
+
+    void record(const TelemetryEvent& event) {
+        if (!ring.push(event)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Offline conversion of a binary telemetry log to CSV
+static bool convertTelemetryToCsv(const std::string& logPath, const std::string& csvPath) {
+    std::ifstream in(logPath, std::ios::binary);
+    std::uint32_t header[3];
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        header[0] != TelemetryLog::kMagic || header[1] != TelemetryLog::kVersion ||
+        header[2] != sizeof(TelemetryEvent)) {
+        std::cerr << logPath << " is not a telemetry log\n";
+        return false;
+    }
+
+    std::ofstream csv(csvPath);
+    csv << "frame,event,entity,kind,wave,x,y,value\n";
+    TelemetryEvent event;
+    while (in.read(reinterpret_cast<char*>(&event), sizeof(event))) {
+        csv << event.frame << ',' << telemetryEventName(event.type) << ',' << event.entityId << ','
+            << static_cast<int>(event.kind) << ',' << event.wave << ',' << event.x << ','
+            << event.y << ',' << event.value << '\n';
+    }
+    return static_cast<bool>(csv);
+}
+
+struct GameOptions {
+    std::uint32_t seed = std::random_device{}();
+    bool headless = false;
+    std::size_t frameLimit = 0;  // 0 = run until the window closes or the replay ends
+    std::string recordPath;
+    std::string capturePath;
+    CaptureFormat captureFormat = CaptureFormat::PngSequence;
+    bool screenShake = true;
+    std::string goldenDir;
+    std::vector<std::size_t> goldenFrames{1, 60, 300, 900, 1800};
+    bool updateGoldenImages = false;
+    std::string telemetryPath;
+    Playfield playfield;
+    unsigned windowWidth = 800;
+    unsigned windowHeight = 600;
+    bool fullscreen = false;
+};
+
+// Parses "WIDTHxHEIGHT", e.g. "1920x1080". Sizes above Playfield::kMaxSize
+// (and inf/nan, which strtof accepts) are rejected.
+static bool parseSize(const std::string& text, float& width, float& height) {
+    char* end = nullptr;
+    float w = std::strtof(text.c_str(), &end);
+    if (!end || (*end != 'x' && *end != 'X')) return false;
+    float h = std::strtof(end + 1, &end);
+    if (*end != '\0' || !(w > 0.f && w <= Playfield::kMaxSize) ||
+        !(h > 0.f && h <= Playfield::kMaxSize)) {
+        return false;
+    }
+    width = w;
+    height = h;
+    return true;
+}
+
+// Reads "key = value" lines; blank lines and lines starting with '#' are skipped.
+static bool loadConfig(const std::string& path, GameOptions& options) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Could not read config " << path << "\n";
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (line.empty() || line[0] == '#') continue;
+
+        std::size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            std::cerr << path << ":" << lineNumber << ": expected key = value\n";
+            return false;
+        }
+        std::string key = line.substr(0, equals);
+        key.erase(key.find_last_not_of(" \t") + 1);
+        const char* valueText = line.c_str() + equals + 1;
+        char* end = nullptr;
+        float value = std::strtof(valueText, &end);
+        if (end == valueText || !std::isfinite(value) || value < 0.f || value > Playfield::kMaxSize ||
+            (value == 0.f && key != "fullscreen")) {
+            std::cerr << path << ":" << lineNumber << ": bad value for " << key << "\n";
+            return false;
+        }
+
+        if (key == "playfield_width") {
+            options.playfield.width = value;
+        } else if (key == "playfield_height") {
+            options.playfield.height = value;
+        } else if (key == "window_width") {
+            options.windowWidth = static_cast<unsigned>(value);
+        } else if (key == "window_height") {
+            options.windowHeight = static_cast<unsigned>(value);
+        } else if (key == "fullscreen") {
+            options.fullscreen = value != 0.f;
+        } else {
+            std::cerr << path << ":" << lineNumber << ": unknown setting " << key << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+enum class EntityKind : std::uint8_t {
+    Bullet,
+    Enemy,
+    PowerUp
+};
+
+struct DespawnRequest {
+    EntityKind kind;
+    std::uint8_t swarm;  // Which enemy swarm, for enemies
+    std::uint32_t index;
+};
+
+class Game {
+private:
+    static constexpr float kFixedDeltaTime = 1.f / 60.f;
+
+    GameOptions options;
+    const Replay* playback;
+    Replay recording;
+    bool fixedStep;
+    std::size_t frameIndex = 0;
+    sf::RenderWindow window;
+    sf::RenderTexture frameTarget;
+    TextureCache textures;  // Declared after the window so it is released first
+    std::unique_ptr<FrameRecorder> recorder;
+    bool ready = true;
+    std::unique_ptr<GoldenImageSet> golden;
+    std::unique_ptr<TelemetryLog> telemetry;
+    std::uint32_t nextEntityId = 1;
+    std::vector<DespawnRequest> despawnQueue;
+    std::vector<Bullet*> visibleBullets;
+    std::vector<Enemy*> visibleEnemies;
+    std::vector<PowerUp*> visiblePowerUps;
+    std::unique_ptr<Player> player;
+    Enemies enemies;
+    std::vector<std::unique_ptr<PowerUp>> powerUps;
+    std::vector<Star> stars;
+    ParticleSystem particles;
+    sf::Clock clock;
+    float enemySpawnTimer = 0.f;
+    float enemySpawnInterval = 1.5f;
+    float powerUpSpawnTimer = 0.f;
+    float powerUpSpawnInterval = 15.f;
+    std::mt19937 rng{std::random_device{}()};
+    int score = 0;
+    int wave = 1;
+    sf::Font font;
+    sf::Text scoreText;
+    sf::Text livesText;
+    sf::Text waveText;
+    float screenShakeTime = 0.f;
+    sf::Vector2f screenShakeOffset;
+
+    void initStars() {
+        const Playfield& field = options.playfield;
+        std::uniform_real_distribution<float> xDist(0.f, field.width);
+        std::uniform_real_distribution<float> yDist(0.f, field.height);
+        std::uniform_real_distribution<float> speedDist(30.f, 120.f);
+        auto scaledCount = [&](int count) {
+            return static_cast<int>(std::lround(count * field.areaScale()));
+        };
+        
+        // Create three layers of stars
+        stars.reserve(scaledCount(80) + scaledCount(40) + scaledCount(15));
+        for (int i = 0; i < scaledCount(80); ++i) {
+            stars.emplace_back(xDist(rng), yDist(rng), 1.f, speedDist(rng) * 0.5f, field.height);
+        }
+        for (int i = 0; i < scaledCount(40); ++i) {
+            stars.emplace_back(xDist(rng), yDist(rng), 2.f, speedDist(rng), field.height);
+        }
+        for (int i = 0; i < scaledCount(15); ++i) {
+            stars.emplace_back(xDist(rng), yDist(rng), 3.f, speedDist(rng) * 1.5f, field.height);
+        }
+    } 
+    
+    // Maps the whole playfield onto the target, letterboxed to keep its aspect ratio
+    sf::View playfieldView(const sf::RenderTarget& target) const {
+        const Playfield& field = options.playfield;
+        sf::View view(sf::FloatRect(0.f, 0.f, field.width, field.height));
+        float targetAspect = static_cast<float>(target.getSize().x) / target.getSize().y;
+        float fieldAspect = field.width / field.height;
+        if (targetAspect > fieldAspect) {
+            float viewportWidth = fieldAspect / targetAspect;
+            view.setViewport(sf::FloatRect((1.f - viewportWidth) / 2, 0.f, viewportWidth, 1.f));
+        } else {
+            float viewportHeight = targetAspect / fieldAspect;
+            view.setViewport(sf::FloatRect(0.f, (1.f - viewportHeight) / 2, 1.f, viewportHeight));
+        }
+        return view;
+    }
+    
+    void addScreenShake(float duration = 0.2f, float intensity = 5.f) {
+        screenShakeTime = duration;
+        std::uniform_real_distribution<float> shakeDist(-intensity, intensity);
+        screenShakeOffset = sf::Vector2f(shakeDist(rng), shakeDist(rng));
+    }
+    
+    void updateScreenShake(float deltaTime) {
+        if (screenShakeTime > 0) {
+            screenShakeTime -= deltaTime;
+            if (screenShakeTime <= 0) {
+                screenShakeOffset = sf::Vector2f(0, 0);
+            } else {
+                std::uniform_real_distribution<float> shakeDist(-5.f, 5.f);
+                screenShakeOffset = sf::Vector2f(shakeDist(rng), shakeDist(rng));
+            }
+        }
+    }
+    
+    bool rendersOffscreen() const {
+        return options.headless || recorder != nullptr;
+    }
+
+    bool sessionFinished() const {
+        if (playback && frameIndex >= playback->inputs.size()) return true;
+        if (options.frameLimit > 0 && frameIndex >= options.frameLimit) return true;
+        return !options.headless && !window.isOpen();
+    }
+
+    void recordEvent(TelemetryEventType type, const GameObject* object, std::uint8_t kind, int value) {
+        if (!telemetry) return;
+        TelemetryEvent event{};
+        event.frame = static_cast<std::uint32_t>(frameIndex);
+        event.type = type;
+        event.kind = kind;
+        event.wave = static_cast<std::uint16_t>(wave);
+        event.value = value;
+        if (object) {
+            event.entityId = object->getId();
+            event.x = object->getPosition().x;
+            event.y = object->getPosition().y;
+        }
+        telemetry->record(event);
+    }
+
+    PlayerInput nextInput() {
+        PlayerInput input;
+        if (playback) {
+            input = PlayerInput::unpack(playback->inputs[frameIndex]);
+        } else if (!options.headless) {
+            input = PlayerInput::fromKeyboard();
+        }
+        if (!options.recordPath.empty()) {
+            recording.inputs.push_back(input.pack());
+        }
+        return input;
+    }
+
+public:
+    // Recording, replaying and headless runs use a fixed timestep and the
+    // given seed so the same inputs always produce the same frames.
+    Game(const GameOptions& opts, const Replay* replay = nullptr)
+        : options(opts), playback(replay), particles(rng) {
+        if (playback) {
+            options.seed = playback->seed;
+            options.playfield = playback->playfield;
+        }
+        fixedStep = options.headless || playback || !options.recordPath.empty();
+        rng.seed(options.seed);
+        std::srand(options.seed);
+        recording.seed = options.seed;
+        recording.playfield = options.playfield;
+
+        if (!options.headless) {
+            if (options.fullscreen) {
+                window.create(sf::VideoMode::getDesktopMode(), "Space Shooter", sf::Style::Fullscreen);
+            } else {
+                window.create(sf::VideoMode(options.windowWidth, options.windowHeight), "Space Shooter");
+            }
+            window.setFramerateLimit(60);
+        }
+        sf::Vector2u outputSize = window.isOpen()
+            ? window.getSize() : sf::Vector2u(options.windowWidth, options.windowHeight);
+        if ((options.headless || !options.capturePath.empty()) &&
+            !frameTarget.create(outputSize.x, outputSize.y)) {
+            std::cerr << "Could not create a " << outputSize.x << "x" << outputSize.y
+                      << " offscreen render target (headless runs on Linux need an X server)\n";
+            ready = false;
+        }
+        if (!options.goldenDir.empty()) {
+            golden = std::make_unique<GoldenImageSet>(options.goldenDir, options.goldenFrames,
+                                                      options.updateGoldenImages);
+        }
+        if (!options.telemetryPath.empty()) {
+            telemetry = std::make_unique<TelemetryLog>(options.telemetryPath);
+            if (!telemetry->isOpen()) {
+                std::cerr << "Could not open " << options.telemetryPath << " for writing\n";
+                telemetry.reset();
+            }
+        }
+        if (ready && !options.capturePath.empty()) {
+            // The recorder's pixel buffers belong to the offscreen target's context
+            if (frameTarget.setActive(true)) {
+                // Blocking on a slow encoder is fine headless, never in front of a player
+                recorder = std::make_unique<FrameRecorder>(outputSize.x, outputSize.y, options.captureFormat,
+                                                           options.capturePath, !options.headless);
+            }
+            if (!recorder || !recorder->isOpen()) {
+                recorder.reset();
+                ready = false;
+            }
+        }
+
+        const Playfield& field = options.playfield;
+        player = std::make_unique<Player>(
+            sf::Vector2f(field.width / 2, field.height - 100.f), 300.f, field,
+            textures.get("player.png"), textures.get("bullet.png"));
+        
+        if (!font.loadFromFile("/System/Library/Fonts/Supplemental/Arial.ttf")) {
+            font.loadFromFile("/System/Library/Fonts/Helvetica.ttc");
+        }
+        
+        scoreText.setFont(font);
+        scoreText.setCharacterSize(24);
+        scoreText.setFillColor(sf::Color::White);
+        scoreText.setPosition(10, 10);
+        
+        livesText.setFont(font);
+        livesText.setCharacterSize(24);
+        livesText.setFillColor(sf::Color::White);
+        livesText.setPosition(10, 40);
+        
+        waveText.setFont(font);
+        waveText.setCharacterSize(24);
+        waveText.setFillColor(sf::Color::White);
+        waveText.setPosition(10, 70);
+        
+        initStars();
+        updateHUD();
+    }
+    
+    void run() {
+        while (!sessionFinished()) {
+            handleEvents();
+            PlayerInput input = nextInput();
+            float deltaTime = fixedStep ? kFixedDeltaTime : clock.restart().asSeconds();
+            if (player->isAlive()) {
+                player->setInput(input);
+                update(deltaTime);
+            }
+            render();
+            if (golden && golden->isCheckpoint(frameIndex)) {
+                checkGoldenImages();
+            }
+            ++frameIndex;
+        }
+
+        if (recorder) {
+            recorder->finish(frameTarget);
+        }
+        if (!options.recordPath.empty() && !recording.save(options.recordPath)) {
+            std::cerr << "Could not write replay " << options.recordPath << "\n";
+        }
+        if (golden) {
+            golden->printSummary();
+        }
+    }
+    
+    // False when the offscreen target or capture output could not be set up
+    bool isReady() const { return ready; }
+
+    bool passedGoldenImages() const {
+        return !golden || golden->passed();
+    }
+    
+private:
+    void handleEvents() {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed) {
+                window.close();
+            }
+        }
+    }
+
+    void spawnPowerUp() {
+        std::uniform_real_distribution<float> xDist(50.f, options.playfield.width - 50.f);
+        std::uniform_int_distribution<int> typeDist(0, 2);
+        
+        PowerUpType type;
+        switch(typeDist(rng)) {
+            case 0: type = PowerUpType::SpreadShot; break;
+            case 1: type = PowerUpType::RapidFire; break;
+            default: type = PowerUpType::Shield; break;
+        }
+        
+        powerUps.push_back(std::make_unique<PowerUp>(
+            sf::Vector2f(xDist(rng), -50.f), type, textures.get("powerup.png")));
+        powerUps.back()->setId(nextEntityId++);
+        recordEvent(TelemetryEventType::PowerUpSpawn, powerUps.back().get(),
+                    static_cast<std::uint8_t>(type), 0);
+    }
+    
+    void spawnEnemy() {
+        std::uniform_real_distribution<float> xDist(50.f, options.playfield.width - 50.f);
+        std::uniform_int_distribution<int> typeDist(0, 3);
         float x = xDist(rng);
         
         EnemyType type;
         // As wave increases, increase chance of special enemies
         if (wave > 3) {
-            typeDist = std::uniform_int_distribution<int>(0, 6);
+            typeDist = std::uniform_int_distribution<int>(0, 9);
             switch(typeDist(rng)) {
                 case 0: 
                 case 1: type = EnemyType::Basic; break;
@@ -600,6 +1871,9 @@ private:
                 case 4:
                 case 5: type = EnemyType::Zigzag; break;
                 case 6: type = EnemyType::Tank; break;
+                case 7: type = EnemyType::SineDive; break;
+                case 8: type = EnemyType::Homing; break;
+                case 9: type = EnemyType::Formation; break;
             }
         } else {
             switch(typeDist(rng)) {
@@ -610,12 +1884,36 @@ private:
             }
         }
         
-        enemies.push_back(std::make_unique<Enemy>(
-            sf::Vector2f(x, -50.f), 150.f, type));
+        switch(type) {
+            case EnemyType::Zigzag: spawnInSwarm<ZigzagMotion>(type, sf::Vector2f(x, -50.f)); break;
+            case EnemyType::SineDive: spawnInSwarm<SineDiveMotion>(type, sf::Vector2f(x, -50.f)); break;
+            case EnemyType::Homing: spawnInSwarm<HomingMotion>(type, sf::Vector2f(x, -50.f)); break;
+            case EnemyType::Formation: spawnFormation(x); break;
+            default: spawnInSwarm<LinearMotion>(type, sf::Vector2f(x, -50.f)); break;
+        }
     }
-    void update() {
-        float deltaTime = clock.restart().asSeconds();
-        
+    
+    // A V of five, flying in lockstep
+    void spawnFormation(float centerX) {
+        const float spacing = 40.f;
+        const float margin = 50.f + 2 * spacing + FormationMotion::kSwayAmplitude;
+        if (options.playfield.width > 2 * margin) {
+            centerX = std::max(margin, std::min(centerX, options.playfield.width - margin));
+        }
+        for (int slot = -2; slot <= 2; ++slot) {
+            spawnInSwarm<FormationMotion>(EnemyType::Formation, sf::Vector2f(
+                centerX + slot * spacing, -50.f - std::abs(slot) * 30.f));
+        }
+    }
+    
+    template <typename Behavior>
+    void spawnInSwarm(EnemyType type, const sf::Vector2f& position) {
+        Enemy& enemy = enemies.swarm<Behavior>().spawn(
+            Enemy(position, 150.f, type, textures.get("enemy.png")));
+        enemy.setId(nextEntityId++);
+        recordEvent(TelemetryEventType::EnemySpawn, &enemy, static_cast<std::uint8_t>(type), 0);
+    }
+    void update(float deltaTime) {
         // Update screen shake
         updateScreenShake(deltaTime);
         
@@ -637,7 +1935,7 @@ private:
         
         // Spawn enemies
         enemySpawnTimer += deltaTime;
-        if (enemySpawnTimer >= enemySpawnInterval) {
+        if (enemySpawnTimer >= enemySpawnInterval / options.playfield.widthScale()) {
             spawnEnemy();
             enemySpawnTimer = 0;
             
@@ -647,78 +1945,194 @@ private:
         
         // Spawn power-ups
         powerUpSpawnTimer += deltaTime;
-        if (powerUpSpawnTimer >= powerUpSpawnInterval) {
+        if (powerUpSpawnTimer >= powerUpSpawnInterval / options.playfield.widthScale()) {
             spawnPowerUp();
             powerUpSpawnTimer = 0;
         }
         
         // Update enemies
-        for (auto it = enemies.begin(); it != enemies.end();) {
-            (*it)->update(deltaTime);
-            if ((*it)->isOffScreen()) {
-                player->loseLife();
-                updateHUD();
-                it = enemies.erase(it);
-            } else {
-                ++it;
-            }
-        }
+        enemies.update(deltaTime, EnemyContext{player->getPosition()});
         
         // Update power-ups
-        for (auto it = powerUps.begin(); it != powerUps.end();) {
-            (*it)->update(deltaTime);
-            if ((*it)->isOffScreen()) {
-                it = powerUps.erase(it);
-            } else {
-                ++it;
-            }
+        for (auto& powerUp : powerUps) {
+            powerUp->update(deltaTime);
         }
         
-        // Check collisions
+        // Queue everything that left the playfield, then check collisions
+        // against what remains
+        queueOutOfBounds();
         checkCollisions();
         
         // Check for wave advancement
         if (score >= wave * 1000) {
             wave++;
             updateHUD();
+            recordEvent(TelemetryEventType::WaveChange, nullptr, 0, wave);
+        }
+        
+        processDespawnQueue();
+    }
+    
+    void queueOutOfBounds() {
+        const Playfield& field = options.playfield;
+        const auto& bullets = player->getBullets();
+        for (std::size_t i = 0; i < bullets.size(); ++i) {
+            if (bullets[i]->isOffScreen(field)) {
+                queueDespawn(EntityKind::Bullet, i, *bullets[i]);
+            }
+        }
+        enemies.forEachSwarm([&](auto& swarm, std::size_t swarmIndex) {
+            for (std::size_t i = 0; i < swarm.members.size(); ++i) {
+                Enemy& enemy = swarm.members[i];
+                if (enemy.isOffScreen(field) && queueDespawn(EntityKind::Enemy, i, enemy, swarmIndex)) {
+                    player->loseLife();
+                    updateHUD();
+                    recordEvent(TelemetryEventType::EnemyEscape, &enemy,
+                                static_cast<std::uint8_t>(enemy.getType()), player->getLives());
+                }
+            }
+        });
+        for (std::size_t i = 0; i < powerUps.size(); ++i) {
+            PowerUp& powerUp = *powerUps[i];
+            if (powerUp.isOffScreen(field) && queueDespawn(EntityKind::PowerUp, i, powerUp)) {
+                recordEvent(TelemetryEventType::PowerUpEscape, &powerUp,
+                            static_cast<std::uint8_t>(powerUp.getType()), 0);
+            }
+        }
+    }
+    
+    bool queueDespawn(EntityKind kind, std::size_t index, GameObject& object, std::size_t swarm = 0) {
+        if (!object.queueDespawn()) return false;
+        despawnQueue.push_back({kind, static_cast<std::uint8_t>(swarm), static_cast<std::uint32_t>(index)});
+        return true;
+    }
+    
+    // Removes everything queued this tick. Going from the highest index down
+    // means a swap-remove never moves an entity that is itself still queued.
+    void processDespawnQueue() {
+        std::sort(despawnQueue.begin(), despawnQueue.end(),
+                  [](const DespawnRequest& a, const DespawnRequest& b) { return a.index > b.index; });
+        for (const auto& request : despawnQueue) {
+            switch(request.kind) {
+                case EntityKind::Bullet: player->removeBullet(request.index); break;
+                case EntityKind::Enemy: enemies.remove(request.swarm, request.index); break;
+                case EntityKind::PowerUp: swapRemove(powerUps, request.index); break;
+            }
+        }
+        despawnQueue.clear();
+    }
+    
+    // Collects the entities whose bounds overlap the view; only those are
+    // submitted for drawing.
+    void cullToView(const sf::FloatRect& visibleArea) {
+        visibleBullets.clear();
+        visibleEnemies.clear();
+        visiblePowerUps.clear();
+        for (const auto& bullet : player->getBullets()) {
+            if (bullet->getBounds().intersects(visibleArea)) {
+                visibleBullets.push_back(bullet.get());
+            }
+        }
+        enemies.forEachSwarm([&](auto& swarm, std::size_t) {
+            for (Enemy& enemy : swarm.members) {
+                if (enemy.getBounds().intersects(visibleArea)) {
+                    visibleEnemies.push_back(&enemy);
+                }
+            }
+        });
+        for (const auto& powerUp : powerUps) {
+            if (powerUp->getBounds().intersects(visibleArea)) {
+                visiblePowerUps.push_back(powerUp.get());
+            }
         }
     }
     
     void render() {
-        window.clear(sf::Color(0, 0, 20));
+        sf::RenderTarget& target = rendersOffscreen()
+            ? static_cast<sf::RenderTarget&>(frameTarget)
+            : static_cast<sf::RenderTarget&>(window);
+        drawScene(target, RenderLayer::All);
+        
+        if (rendersOffscreen()) {
+            frameTarget.display();
+            if (recorder) {
+                recorder->capture(frameTarget);
+            }
+            if (window.isOpen()) {
+                sf::Vector2u size = frameTarget.getSize();
+                window.setView(sf::View(sf::FloatRect(0.f, 0.f, size.x, size.y)));
+                window.draw(sf::Sprite(frameTarget.getTexture()));
+                window.display();
+            }
+        } else {
+            window.display();
+        }
+    }
+    
+    // Renders each layer on its own, plus the full frame, and checks them
+    // against the golden images for this frame.
+    void checkGoldenImages() {
+        for (const auto& layer : kGoldenLayers) {
+            drawScene(frameTarget, layer.mask);
+            frameTarget.display();
+            golden->check(frameIndex, layer.name, frameTarget.getTexture().copyToImage());
+        }
+    }
+    
+    void drawScene(sf::RenderTarget& target, unsigned layers) {
+        target.clear(sf::Color(0, 0, 20));
         
         // Apply screen shake
-        sf::View view = window.getDefaultView();
-        view.move(screenShakeOffset);
-        window.setView(view);
+        sf::View view = playfieldView(target);
+        if (options.screenShake) {
+            view.move(screenShakeOffset);
+        }
+        target.setView(view);
+        sf::FloatRect visibleArea(view.getCenter() - view.getSize() / 2.f, view.getSize());
+        cullToView(visibleArea);
         
         // Draw stars
-        for (auto& star : stars) {
-            star.draw(window);
+        if (layers & RenderLayer::Stars) {
+            for (auto& star : stars) {
+                star.draw(target);
+            }
         }
         
         // Draw particles
-        particles.draw(window);
+        if (layers & RenderLayer::Particles) {
+            particles.draw(target, visibleArea);
+        }
         
         // Draw game objects
-        player->draw(window);
-        for (const auto& enemy : enemies) {
-            enemy->draw(window);
+        if (layers & RenderLayer::Player) {
+            player->draw(target);
+            for (Bullet* bullet : visibleBullets) {
+                bullet->draw(target);
+            }
         }
-        for (const auto& powerUp : powerUps) {
-            powerUp->draw(window);
+        if (layers & RenderLayer::Enemies) {
+            for (Enemy* enemy : visibleEnemies) {
+                enemy->draw(target);
+            }
+        }
+        if (layers & RenderLayer::PowerUps) {
+            for (PowerUp* powerUp : visiblePowerUps) {
+                powerUp->draw(target);
+            }
         }
         
         // Reset view for HUD
-        window.setView(window.getDefaultView());
+        target.setView(playfieldView(target));
         
         // Draw HUD
-        window.draw(scoreText);
-        window.draw(livesText);
-        window.draw(waveText);
+        if (layers & RenderLayer::Hud) {
+            target.draw(scoreText);
+            target.draw(livesText);
+            target.draw(waveText);
+        }
         
         // Draw game over message if player is dead
-        if (!player->isAlive()) {
+        if ((layers & RenderLayer::GameOver) && !player->isAlive()) {
             sf::Text gameOverText;
             gameOverText.setFont(font);
             gameOverText.setString("GAME OVER\nFinal Score: " + std::to_string(score) +
@@ -728,53 +2142,56 @@ private:
             
             sf::FloatRect textBounds = gameOverText.getLocalBounds();
             gameOverText.setPosition(
-                (800 - textBounds.width) / 2,
-                (600 - textBounds.height) / 2
+                (options.playfield.width - textBounds.width) / 2,
+                (options.playfield.height - textBounds.height) / 2
             );
             
-            window.draw(gameOverText);
+            target.draw(gameOverText);
         }
-        
-        window.display();
     }
     
     void checkCollisions() {
         // Check bullet-enemy collisions
         const auto& bullets = player->getBullets();
-        for (auto enemyIt = enemies.begin(); enemyIt != enemies.end();) {
-            bool enemyDestroyed = false;
-            for (const auto& bullet : bullets) {
-                if ((*enemyIt)->isColliding(*bullet)) {
-                    if ((*enemyIt)->hit()) {  // Returns true if enemy is destroyed
-                        // Add explosion particles
-                        particles.addExplosion((*enemyIt)->getPosition(),
-                            sf::Color(255, 200, 100));
+        enemies.forEachSwarm([&](auto& swarm, std::size_t swarmIndex) {
+            for (std::size_t i = 0; i < swarm.members.size(); ++i) {
+                Enemy& enemy = swarm.members[i];
+                if (enemy.isDespawnQueued()) continue;
+                for (const auto& bullet : bullets) {
+                    if (!bullet->isDespawnQueued() && enemy.isColliding(*bullet)) {
+                        if (enemy.hit()) {  // Returns true if enemy is destroyed
+                            // Add explosion particles
+                            particles.addExplosion(enemy.getPosition(),
+                                sf::Color(255, 200, 100));
                         
-                        // Add screen shake
-                        addScreenShake();
+                            // Add screen shake
+                            addScreenShake();
                         
-                        // Add score
-                        score += (*enemyIt)->getScoreValue();
-                        updateHUD();
-                        enemyDestroyed = true;
+                            // Add score
+                            score += enemy.getScoreValue();
+                            updateHUD();
+                            queueDespawn(EntityKind::Enemy, i, enemy, swarmIndex);
+                            recordEvent(TelemetryEventType::EnemyKill, &enemy,
+                                        static_cast<std::uint8_t>(enemy.getType()),
+                                        enemy.getScoreValue());
+                        } else {
+                            recordEvent(TelemetryEventType::EnemyHit, &enemy,
+                                        static_cast<std::uint8_t>(enemy.getType()), 0);
+                        }
+                        break;
                     }
-                    break;
                 }
             }
-            if (enemyDestroyed) {
-                enemyIt = enemies.erase(enemyIt);
-            } else {
-                ++enemyIt;
-            }
-        }
+        });
         
         // Check player-powerup collisions
-        for (auto it = powerUps.begin(); it != powerUps.end();) {
-            if ((*it)->isColliding(*player)) {
-                player->activatePowerUp((*it)->getType());
-                it = powerUps.erase(it);
-            } else {
-                ++it;
+        for (std::size_t i = 0; i < powerUps.size(); ++i) {
+            PowerUp& powerUp = *powerUps[i];
+            if (!powerUp.isDespawnQueued() && powerUp.isColliding(*player)) {
+                player->activatePowerUp(powerUp.getType());
+                recordEvent(TelemetryEventType::PowerUpPickup, &powerUp,
+                            static_cast<std::uint8_t>(powerUp.getType()), 0);
+                queueDespawn(EntityKind::PowerUp, i, powerUp);
             }
         }
     }
@@ -786,9 +2203,269 @@ private:
     }
 };
 
-int main() {
-    Game game;
+// The enemy as it was before behavior policies: one heap object each, a
+// virtual update and a type check per enemy per frame. Kept only as the
+// baseline for runEnemyBenchmark().
+class LegacyEnemy : public GameObject {
+private:
+    EnemyType type;
+    float zigzagTimer = 0.f;
+    float zigzagFrequency = 2.f;
+    float originalX;
+
+public:
+    LegacyEnemy(const sf::Vector2f& pos, float spd, EnemyType t, const sf::Texture& texture)
+        : GameObject(pos, spd), type(t), originalX(pos.x) {
+        sprite = std::make_unique<sf::Sprite>(texture);
+        velocity = sf::Vector2f(0.f, speed);
+    }
+
+    void update(float deltaTime) override {
+        if (type == EnemyType::Zigzag) {
+            zigzagTimer += deltaTime;
+            float xOffset = std::sin(zigzagTimer * zigzagFrequency) * 100.f;
+            position.x = originalX + xOffset;
+            position.y += velocity.y * deltaTime;
+        } else {
+            position += velocity * deltaTime;
+        }
+    }
+};
+
+// Times enemy movement for the same mixed population of linear and zigzag
+// enemies, stored and dispatched the old way and as policy swarms.
+static void runEnemyBenchmark(std::size_t count) {
+    const int frames = 600;
+    const float deltaTime = 1.f / 60.f;
+    const EnemyType types[] = {EnemyType::Basic, EnemyType::Scout, EnemyType::Tank, EnemyType::Zigzag};
+
+    TextureCache textures;
+    const sf::Texture& texture = textures.get("enemy.png");
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> xDist(50.f, 750.f);
+    std::vector<std::unique_ptr<GameObject>> legacy;
+    EnemyRoster<LinearMotion, ZigzagMotion> roster;
+    for (std::size_t i = 0; i < count; ++i) {
+        EnemyType type = types[rng() % 4];
+        sf::Vector2f position(xDist(rng), -50.f);
+        legacy.push_back(std::make_unique<LegacyEnemy>(position, 150.f, type, texture));
+        if (type == EnemyType::Zigzag) {
+            roster.swarm<ZigzagMotion>().spawn(Enemy(position, 150.f, type, texture));
+        } else {
+            roster.swarm<LinearMotion>().spawn(Enemy(position, 150.f, type, texture));
+        }
+    }
+
+    auto nanosecondsPerUpdate = [&](auto&& updateAll) {
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            updateAll();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / (static_cast<double>(frames) * count);
+    };
+
+    EnemyContext context{sf::Vector2f(400.f, 500.f)};
+    double legacyTime = nanosecondsPerUpdate([&] {
+        for (auto& enemy : legacy) {
+            enemy->update(deltaTime);
+        }
+    });
+    double policyTime = nanosecondsPerUpdate([&] { roster.update(deltaTime, context); });
+
+    // Use the results so the loops can't be optimized away
+    float checksum = 0.f;
+    for (const auto& enemy : legacy) {
+        checksum += enemy->getPosition().x;
+    }
+    roster.forEachSwarm([&](auto& swarm, std::size_t) {
+        for (const Enemy& enemy : swarm.members) {
+            checksum -= enemy.getPosition().x;
+        }
+    });
+
+    std::cout << count << " enemies x " << frames << " frames\n"
+              << "  virtual + switch: " << legacyTime << " ns per enemy update\n"
+              << "  policy swarms:    " << policyTime << " ns per enemy update\n"
+              << "  (position checksum delta " << checksum << ")\n";
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --seed N          Seed the RNG (recorded into replays)\n"
+              << "  --record FILE     Record player input to a replay file\n"
+              << "  --replay FILE     Play back a replay file\n"
+              << "  --capture PATH    Capture frames: PATH.gif, or a directory of PNGs\n"
+              << "  --headless        Render offscreen only, without opening a window\n"
+              << "  --frames N        Stop after N frames\n"
+              << "  --no-shake        Disable screen shake\n"
+              << "  --golden DIR      Headless run checked against golden images in DIR\n"
+              << "  --golden-frames L Comma-separated frames to check (default 1,60,300,900,1800)\n"
+              << "  --update-golden   Write the golden images instead of checking them\n"
+              << "  --config FILE     Load playfield and window settings\n"
+              << "  --playfield WxH   Playfield size in world units (default 800x600)\n"
+              << "  --window WxH      Window or capture size in pixels (default 800x600)\n"
+              << "  --fullscreen      Fullscreen at the desktop resolution\n"
+              << "  --telemetry FILE  Stream gameplay events to a binary log\n"
+              << "  --telemetry-csv LOG CSV  Convert a telemetry log to CSV and exit\n"
+              << "  --bench-enemies N Benchmark enemy update dispatch with N enemies and exit\n";
+}
+
+int main(int argc, char* argv[]) {
+    GameOptions options;
+    Replay replay;
+    std::string replayPath;
+    bool seedGiven = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--seed" && hasValue) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            seedGiven = true;
+        } else if (arg == "--record" && hasValue) {
+            options.recordPath = argv[++i];
+        } else if (arg == "--replay" && hasValue) {
+            replayPath = argv[++i];
+        } else if (arg == "--capture" && hasValue) {
+            options.capturePath = argv[++i];
+            std::string extension = std::filesystem::path(options.capturePath).extension().string();
+            options.captureFormat = extension == ".gif" ? CaptureFormat::Gif : CaptureFormat::PngSequence;
+        } else if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--frames" && hasValue) {
+            options.frameLimit = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--no-shake") {
+            options.screenShake = false;
+        } else if (arg == "--golden" && hasValue) {
+            options.goldenDir = argv[++i];
+        } else if (arg == "--golden-frames" && hasValue) {
+            options.goldenFrames.clear();
+            for (char* cursor = argv[++i]; *cursor;) {
+                char* end = nullptr;
+                std::size_t frame = std::strtoul(cursor, &end, 10);
+                if (end == cursor || (*end != ',' && *end != '\0')) {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                options.goldenFrames.push_back(frame);
+                cursor = *end == ',' ? end + 1 : end;
+            }
+            if (options.goldenFrames.empty()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--update-golden") {
+            options.updateGoldenImages = true;
+        } else if (arg == "--config" && hasValue) {
+            if (!loadConfig(argv[++i], options)) {
+                return 1;
+            }
+        } else if (arg == "--playfield" && hasValue) {
+            if (!parseSize(argv[++i], options.playfield.width, options.playfield.height)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--window" && hasValue) {
+            float width, height;
+            if (!parseSize(argv[++i], width, height)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.windowWidth = static_cast<unsigned>(width);
+            options.windowHeight = static_cast<unsigned>(height);
+        } else if (arg == "--fullscreen") {
+            options.fullscreen = true;
+        } else if (arg == "--telemetry" && hasValue) {
+            options.telemetryPath = argv[++i];
+        } else if (arg == "--bench-enemies" && hasValue) {
+            const char* countText = argv[++i];
+            char* end = nullptr;
+            unsigned long count = std::strtoul(countText, &end, 10);
+            // strtoul wraps negative input instead of failing
+            if (end == countText || *end != '\0' || *countText == '-' || count == 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            runEnemyBenchmark(count);
+            return 0;
+        } else if (arg == "--telemetry-csv" && i + 2 < argc) {
+            // Offline tool: convert a log and exit
+            return convertTelemetryToCsv(argv[i + 1], argv[i + 2]) ? 0 : 1;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!replayPath.empty()) {
+        if (!replay.load(replayPath)) {
+            std::cerr << "Could not read replay " << replayPath << "\n";
+            return 1;
+        }
+        if (replay.playfield.width != options.playfield.width ||
+            replay.playfield.height != options.playfield.height) {
+            std::cerr << "Replay was recorded on a " << replay.playfield.width << "x"
+                      << replay.playfield.height << " playfield; using that\n";
+            options.playfield = replay.playfield;
+        }
+    }
+    if (!options.playfield.isValid()) {
+        std::cerr << "The playfield must be between " << Playfield::kMinSize << "x"
+                  << Playfield::kMinSize << " and " << Playfield::kMaxSize << "x"
+                  << Playfield::kMaxSize << "\n";
+        return 1;
+    }
+    if (!options.goldenDir.empty()) {
+        options.headless = true;
+        options.screenShake = false;
+
+        if (replayPath.empty() && !seedGiven) {
+            options.seed = GoldenImageSet::kDefaultSeed;
+        }
+        std::uint32_t sessionSeed = replayPath.empty() ? options.seed : replay.seed;
+        if (options.updateGoldenImages) {
+            if (!GoldenImageSet::saveSeed(options.goldenDir, sessionSeed)) {
+                std::cerr << "Could not write the seed to " << options.goldenDir << "\n";
+                return 1;
+            }
+        } else {
+            std::uint32_t recordedSeed;
+            if (!GoldenImageSet::loadSeed(options.goldenDir, recordedSeed)) {
+                std::cerr << "No seed recorded in " << options.goldenDir
+                          << "; create the golden images with --update-golden first\n";
+                return 1;
+            }
+            if (replayPath.empty() && !seedGiven) {
+                options.seed = sessionSeed = recordedSeed;
+            }
+            if (sessionSeed != recordedSeed) {
+                std::cerr << "Golden images in " << options.goldenDir << " were made with seed "
+                          << recordedSeed << ", not " << sessionSeed << "\n";
+                return 1;
+            }
+        }
+
+        if (replayPath.empty() && options.frameLimit == 0 && !options.goldenFrames.empty()) {
+            options.frameLimit = *std::max_element(options.goldenFrames.begin(),
+                                                   options.goldenFrames.end()) + 1;
+        }
+    }
+    if (options.headless) {
+        // No window is opened, but on Linux SFML 2 still creates its GL
+        // contexts through GLX, so an X server (e.g. Xvfb) is required. This
+        // makes Mesa render with llvmpipe so no GPU is needed; ignored elsewhere.
+        setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+        if (replayPath.empty() && options.frameLimit == 0) {
+            options.frameLimit = 600;
+        }
+    }
+
+    Game game(options, replayPath.empty() ? nullptr : &replay);
+    if (!game.isReady()) {
+        return 1;
+    }
     game.run();
-    return 0;
+    return game.passedGoldenImages() ? 0 : 1;
 }
 // ./SpaceShooter
\ No newline at end of file